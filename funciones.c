@@ -3,11 +3,59 @@
 #include <string.h>
 #include <ctype.h>
 #include <time.h>
+#include <math.h>
+#include <stdint.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "funciones.h"
 
 #define ARCHIVO_DATOS "datos_zonas.txt"
 #define ARCHIVO_RESPALDO "respaldo_zonas.txt"
 
+// Parametros del detector de anomalias
+#define ALFA_EWMA 0.3f
+#define MIN_MUESTRAS_DETECTOR 5
+#define UMBRAL_Z 3.5f
+#define UMBRAL_MAD 4.0f
+#define LIMITE_REPETICIONES 3
+#define DISPERSION_MINIMA 0.15f // Fraccion de la media tolerada como variacion normal
+
+#define NUM_CONTAMINANTES 5 // Las primeras variables del registro son contaminantes
+#define MAX_RETARDO 3
+
+// Parametros de la simulacion Monte Carlo
+#define MAX_TRAYECTORIAS 100000
+#define HORAS_SIMULACION 24
+#define PERSISTENCIA_HORARIA 0.9f // Coeficiente AR(1) de una hora a la siguiente
+#define FONDO_CO2 400.0f          // CO2 de fondo que no depende de emisiones locales
+#define VIENTO_MINIMO 0.5f
+
+// Parametros del analisis de correlacion
+#define BLOQUE_ANALISIS 64
+#define NUM_COLUMNAS (NUM_VARIABLES + 1) // Variables mas el tiempo (dias)
+
+typedef struct {
+    double n;
+    double referencia[NUM_COLUMNAS];
+    double suma[NUM_COLUMNAS];
+    double productos[NUM_COLUMNAS][NUM_COLUMNAS]; // Solo se usa el triangulo inferior
+} AcumuladorEstadistico;
+
+typedef struct {
+    double n, sx, sy, sxx, syy, sxy;
+} AcumuladorPares;
+
+static int politica_duplicados = POLITICA_ULTIMO_GANA;
+static int excluir_sospechosos = 0;
+
+static int consolidar_pendientes(Zona *z);
+static void reconstruir_estado_detectores(Zona *z);
+static void evaluar_registro(Zona *z, RegistroDia *r);
+static void evaluar_registro_atrasado(const Zona *z, RegistroDia *r);
+static float *valor_variable(RegistroDia *r, int k);
+static float leer_variable(const RegistroDia *r, int k);
+
 // Carga los datos desde un archivo de texto
 int cargar_zonas(Zona zonas[], int *num_zonas) {
     FILE *f = fopen(ARCHIVO_DATOS, "r");
@@ -25,24 +73,42 @@ int cargar_zonas(Zona zonas[], int *num_zonas) {
         int dias;
         if (fscanf(f, "%d\n", &dias) != 1) { fclose(f); return 0; }
         zonas[i].dias_registrados = dias;
-        // Leer historial de días
+        zonas[i].num_pendientes = 0;
+        // Leer historial de días (las banderas de sospecha al final son opcionales)
+        int sin_banderas = 0;
         for (int j = 0; j < dias; j++) {
             RegistroDia *r = &zonas[i].historial[j];
-            if (fscanf(f, "%10s %f %f %f %f %f %f %f %f\n",
-                       r->fecha, &r->pm25, &r->pm10, &r->co2, &r->so2, &r->no2,
-                       &r->temperatura, &r->humedad, &r->velocidad_viento) != 9) {
+            char linea[200];
+            unsigned int anomalias = 0, sensor_fijo = 0;
+            if (!fgets(linea, sizeof(linea), f)) { fclose(f); return 0; }
+            int leidos = sscanf(linea, "%10s %f %f %f %f %f %f %f %f %u %u",
+                                r->fecha, &r->pm25, &r->pm10, &r->co2, &r->so2, &r->no2,
+                                &r->temperatura, &r->humedad, &r->velocidad_viento,
+                                &anomalias, &sensor_fijo);
+            if (leidos != 9 && leidos != 11) {
                 fclose(f);
                 return 0;
             }
+            if (leidos == 9) sin_banderas = 1;
+            r->anomalias = (unsigned char)anomalias;
+            r->sensor_fijo = (unsigned char)sensor_fijo;
         }
         qsort(zonas[i].historial, zonas[i].dias_registrados, sizeof(RegistroDia), comparar_fechas);
+        // Archivos antiguos no traen banderas: se evaluan una vez en orden cronologico
+        if (sin_banderas)
+            recalcular_detectores(&zonas[i]);
+        else
+            reconstruir_estado_detectores(&zonas[i]);
     }
     fclose(f);
     return 1;
 }
 
 // Guarda los datos en un archivo de texto
+// Las lecturas pendientes se fusionan antes de escribir para no perderlas
 int guardar_zonas(Zona zonas[], int num_zonas) {
+    for (int i = 0; i < num_zonas; i++)
+        consolidar_pendientes(&zonas[i]);
     FILE *f = fopen(ARCHIVO_DATOS, "w");
     if (!f) return 0;
     fprintf(f, "%d\n", num_zonas);
@@ -51,9 +117,10 @@ int guardar_zonas(Zona zonas[], int num_zonas) {
         fprintf(f, "%d\n", zonas[i].dias_registrados);
         for (int j = 0; j < zonas[i].dias_registrados; j++) {
             RegistroDia *r = &zonas[i].historial[j];
-            fprintf(f, "%s %.1f %.1f %.1f %.1f %.1f %.1f %.1f %.1f\n",
+            fprintf(f, "%s %.1f %.1f %.1f %.1f %.1f %.1f %.1f %.1f %u %u\n",
                     r->fecha, r->pm25, r->pm10, r->co2, r->so2, r->no2,
-                    r->temperatura, r->humedad, r->velocidad_viento);
+                    r->temperatura, r->humedad, r->velocidad_viento,
+                    (unsigned int)r->anomalias, (unsigned int)r->sensor_fijo);
         }
     }
     fclose(f);
@@ -66,6 +133,294 @@ int comparar_fechas(const void *a, const void *b) {
     return strcmp(regA->fecha, regB->fecha);
 }
 
+// Combina dos registros con la misma fecha segun la politica configurada.
+// 'muestras' es la cantidad de lecturas que ya estan promediadas en 'destino'.
+static void resolver_duplicado(RegistroDia *destino, const RegistroDia *nuevo, int muestras) {
+    if (politica_duplicados == POLITICA_ULTIMO_GANA) {
+        *destino = *nuevo;
+        return;
+    }
+    float n = (float)muestras;
+    for (int k = 0; k < NUM_VARIABLES; k++) {
+        float *valor = valor_variable(destino, k);
+        *valor = (*valor * n + leer_variable(nuevo, k)) / (n + 1);
+    }
+    // Un promedio que incluye lecturas sospechosas sigue siendo sospechoso
+    destino->anomalias |= nuevo->anomalias;
+    destino->sensor_fijo |= nuevo->sensor_fijo;
+}
+
+// Fusiona las lecturas pendientes con el historial (ya ordenado) en una sola pasada.
+// Si hay mas registros que DIAS_HISTORIAL se conservan los mas recientes.
+// Las banderas de cada lectura se conservan; solo el estado de los detectores se
+// reconstruye sobre el historial resultante.
+// Devuelve cuantas lecturas pendientes quedaron fuera por ser anteriores a esa ventana.
+static int consolidar_pendientes(Zona *z) {
+    if (z->num_pendientes == 0) return 0;
+
+    // Ordenamiento por insercion: el lote es pequeno, suele llegar casi ordenado
+    // y al ser estable la lectura mas reciente de una misma fecha queda al final
+    for (int i = 1; i < z->num_pendientes; i++) {
+        RegistroDia clave = z->pendientes[i];
+        int j = i - 1;
+        while (j >= 0 && strcmp(z->pendientes[j].fecha, clave.fecha) > 0) {
+            z->pendientes[j + 1] = z->pendientes[j];
+            j--;
+        }
+        z->pendientes[j + 1] = clave;
+    }
+
+    RegistroDia combinado[DIAS_HISTORIAL + MAX_PENDIENTES];
+    int muestras[DIAS_HISTORIAL + MAX_PENDIENTES];
+    int nuevas[DIAS_HISTORIAL + MAX_PENDIENTES]; // Lecturas pendientes incluidas en cada registro
+    int n = 0, i = 0, j = 0;
+    while (i < z->dias_registrados || j < z->num_pendientes) {
+        const RegistroDia *siguiente;
+        int es_pendiente = 0;
+        // Ante fechas iguales se toma primero el historial para que la lectura nueva gane
+        if (j >= z->num_pendientes ||
+            (i < z->dias_registrados && strcmp(z->historial[i].fecha, z->pendientes[j].fecha) <= 0)) {
+            siguiente = &z->historial[i++];
+        } else {
+            siguiente = &z->pendientes[j++];
+            es_pendiente = 1;
+        }
+        if (n > 0 && strcmp(combinado[n - 1].fecha, siguiente->fecha) == 0) {
+            resolver_duplicado(&combinado[n - 1], siguiente, muestras[n - 1]);
+            muestras[n - 1]++;
+            nuevas[n - 1] += es_pendiente;
+        } else {
+            combinado[n] = *siguiente;
+            muestras[n] = 1;
+            nuevas[n] = es_pendiente;
+            n++;
+        }
+    }
+
+    int inicio = (n > DIAS_HISTORIAL) ? n - DIAS_HISTORIAL : 0;
+    int descartadas = 0;
+    for (int k = 0; k < inicio; k++)
+        descartadas += nuevas[k];
+    memcpy(z->historial, &combinado[inicio], (n - inicio) * sizeof(RegistroDia));
+    z->dias_registrados = n - inicio;
+    z->num_pendientes = 0;
+    reconstruir_estado_detectores(z);
+    return descartadas;
+}
+
+// Agrega una lectura a la zona. Si llega en orden se anexa directamente al historial
+// y pasa por los detectores en O(1); si no, se evalua contra los dias anteriores a
+// su fecha y queda en el buffer de pendientes hasta la siguiente consolidacion.
+// Devuelve las lecturas descartadas si el buffer lleno obligo a consolidar.
+static int encolar_registro(Zona *z, const RegistroDia *r) {
+    if (z->num_pendientes == 0 &&
+        (z->dias_registrados == 0 || strcmp(r->fecha, z->historial[z->dias_registrados - 1].fecha) > 0)) {
+        if (z->dias_registrados == DIAS_HISTORIAL) {
+            memmove(&z->historial[0], &z->historial[1], (DIAS_HISTORIAL - 1) * sizeof(RegistroDia));
+            z->dias_registrados--;
+        }
+        z->historial[z->dias_registrados++] = *r;
+        evaluar_registro(z, &z->historial[z->dias_registrados - 1]);
+        return 0;
+    }
+    int descartadas = 0;
+    if (z->num_pendientes == MAX_PENDIENTES)
+        descartadas = consolidar_pendientes(z);
+    z->pendientes[z->num_pendientes] = *r;
+    evaluar_registro_atrasado(z, &z->pendientes[z->num_pendientes]);
+    z->num_pendientes++;
+    return descartadas;
+}
+
+static const RegistroDia *buscar_registro(const Zona *z, const char *fecha) {
+    for (int i = 0; i < z->dias_registrados; i++) {
+        if (strcmp(z->historial[i].fecha, fecha) == 0) return &z->historial[i];
+    }
+    return NULL;
+}
+
+// Acceso por indice a las variables de un registro (0-4 contaminantes, 5-7 clima)
+static float *valor_variable(RegistroDia *r, int k) {
+    switch (k) {
+        case 0: return &r->pm25;
+        case 1: return &r->pm10;
+        case 2: return &r->co2;
+        case 3: return &r->so2;
+        case 4: return &r->no2;
+        case 5: return &r->temperatura;
+        case 6: return &r->humedad;
+        default: return &r->velocidad_viento;
+    }
+}
+
+static float leer_variable(const RegistroDia *r, int k) {
+    switch (k) {
+        case 0: return r->pm25;
+        case 1: return r->pm10;
+        case 2: return r->co2;
+        case 3: return r->so2;
+        case 4: return r->no2;
+        case 5: return r->temperatura;
+        case 6: return r->humedad;
+        default: return r->velocidad_viento;
+    }
+}
+
+static const char *nombre_variable(int k) {
+    static const char *nombres[NUM_VARIABLES] = {
+        "PM2.5", "PM10", "CO2", "SO2", "NO2", "Temperatura", "Humedad", "Viento"
+    };
+    return (k >= 0 && k < NUM_VARIABLES) ? nombres[k] : "";
+}
+
+static int comparar_floats(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static float mediana(float valores[], int n) {
+    qsort(valores, n, sizeof(float), comparar_floats);
+    return (n % 2) ? valores[n / 2] : (valores[n / 2 - 1] + valores[n / 2]) / 2.0f;
+}
+
+// Evalua un valor contra el estado del detector y luego lo incorpora.
+// Devuelve 1 si es atipico segun EWMA y MAD a la vez (con pocos datos un solo
+// criterio da demasiados falsos positivos). El costo no depende del historial.
+static int actualizar_detector(DetectorVariable *d, float x, int *fijo) {
+    int atipico = 0;
+    int llenos = (d->muestras < VENTANA_MAD) ? d->muestras : VENTANA_MAD;
+
+    if (d->muestras >= MIN_MUESTRAS_DETECTOR) {
+        // La dispersion minima evita marcar variaciones pequenas cuando el historial es muy estable
+        float piso = DISPERSION_MINIMA * fabsf(d->media);
+        float desviacion = sqrtf(d->varianza);
+        if (desviacion < piso) desviacion = piso;
+        int atipico_ewma = desviacion > 0 && fabsf(x - d->media) > UMBRAL_Z * desviacion;
+
+        float copia[VENTANA_MAD];
+        memcpy(copia, d->ventana, llenos * sizeof(float));
+        float centro = mediana(copia, llenos);
+        for (int i = 0; i < llenos; i++)
+            copia[i] = fabsf(copia[i] - centro);
+        float mad = mediana(copia, llenos) * 1.4826f; // Escala equivalente a la desviacion estandar
+        if (mad < piso) mad = piso;
+        atipico = atipico_ewma && mad > 0 && fabsf(x - centro) > UMBRAL_MAD * mad;
+    }
+
+    // Sensor trabado: repite exactamente el mismo valor varias lecturas seguidas
+    if (d->muestras > 0 && x == d->ventana[(d->muestras - 1) % VENTANA_MAD])
+        d->repeticiones++;
+    else
+        d->repeticiones = 1;
+    *fijo = d->repeticiones >= LIMITE_REPETICIONES;
+
+    if (d->muestras == 0) {
+        d->media = x;
+        d->varianza = 0;
+    } else {
+        // Con pocas muestras se usa el promedio acumulado para no subestimar la varianza
+        float alfa = 1.0f / (d->muestras + 1);
+        if (alfa < ALFA_EWMA) alfa = ALFA_EWMA;
+        float diferencia = x - d->media;
+        float incremento = alfa * diferencia;
+        d->media += incremento;
+        d->varianza = (1 - alfa) * (d->varianza + diferencia * incremento);
+    }
+    d->ventana[d->muestras % VENTANA_MAD] = x;
+    d->muestras++;
+    return atipico;
+}
+
+// Evalua una lectura con los detectores dados, marca sus variables sospechosas
+// y la incorpora al estado
+static void evaluar_con_detectores(DetectorVariable detectores[], RegistroDia *r) {
+    r->anomalias = 0;
+    r->sensor_fijo = 0;
+    for (int k = 0; k < NUM_VARIABLES; k++) {
+        int fijo;
+        if (actualizar_detector(&detectores[k], leer_variable(r, k), &fijo))
+            r->anomalias |= 1 << k;
+        if (fijo)
+            r->sensor_fijo |= 1 << k;
+    }
+}
+
+// Procesa una lectura nueva (la mas reciente) de la zona
+static void evaluar_registro(Zona *z, RegistroDia *r) {
+    evaluar_con_detectores(z->detectores, r);
+}
+
+// Evalua una lectura atrasada o editada solo contra los dias anteriores a su fecha,
+// sin alterar el estado de la zona ni las banderas de los demas registros
+static void evaluar_registro_atrasado(const Zona *z, RegistroDia *r) {
+    DetectorVariable temporales[NUM_VARIABLES];
+    memset(temporales, 0, sizeof(temporales));
+    for (int j = 0; j < z->dias_registrados && strcmp(z->historial[j].fecha, r->fecha) < 0; j++) {
+        for (int k = 0; k < NUM_VARIABLES; k++) {
+            int fijo;
+            actualizar_detector(&temporales[k], leer_variable(&z->historial[j], k), &fijo);
+        }
+    }
+    evaluar_con_detectores(temporales, r);
+}
+
+// Reconstruye solo el estado de los detectores a partir del historial, conservando
+// las banderas que cada registro recibio al llegar
+static void reconstruir_estado_detectores(Zona *z) {
+    memset(z->detectores, 0, sizeof(z->detectores));
+    for (int j = 0; j < z->dias_registrados; j++) {
+        for (int k = 0; k < NUM_VARIABLES; k++) {
+            int fijo;
+            actualizar_detector(&z->detectores[k], leer_variable(&z->historial[j], k), &fijo);
+        }
+    }
+}
+
+// Evalua todo el historial en orden cronologico; se usa con datos nuevos o con
+// archivos que no traen banderas guardadas
+void recalcular_detectores(Zona *z) {
+    memset(z->detectores, 0, sizeof(z->detectores));
+    for (int j = 0; j < z->dias_registrados; j++)
+        evaluar_registro(z, &z->historial[j]);
+}
+
+static void describir_banderas(unsigned char banderas, char *destino) {
+    destino[0] = '\0';
+    for (int k = 0; k < NUM_VARIABLES; k++) {
+        if (!(banderas & (1 << k))) continue;
+        if (destino[0] != '\0') strcat(destino, ", ");
+        strcat(destino, nombre_variable(k));
+    }
+}
+
+// Prediccion ponderada (0.6, 0.3, 0.1) de los tres ultimos valores de cada variable.
+// Si esta activa la exclusion, se saltan los valores marcados como sospechosos.
+static int calcular_prediccion(const Zona *z, float prediccion[NUM_VARIABLES]) {
+    const float pesos[3] = {0.6f, 0.3f, 0.1f};
+    if (z->dias_registrados < 3) return 0;
+
+    for (int k = 0; k < NUM_VARIABLES; k++) {
+        float suma = 0, suma_pesos = 0;
+        int usados = 0;
+        for (int j = z->dias_registrados - 1; j >= 0 && usados < 3; j--) {
+            const RegistroDia *r = &z->historial[j];
+            if (excluir_sospechosos && ((r->anomalias | r->sensor_fijo) & (1 << k))) continue;
+            suma += leer_variable(r, k) * pesos[usados];
+            suma_pesos += pesos[usados];
+            usados++;
+        }
+        if (usados == 0) {
+            // Todas las lecturas son sospechosas: se usa la prediccion sin filtrar
+            for (int j = 0; j < 3; j++) {
+                suma += leer_variable(&z->historial[z->dias_registrados - 1 - j], k) * pesos[j];
+                suma_pesos += pesos[j];
+            }
+        }
+        prediccion[k] = suma / suma_pesos;
+    }
+    return 1;
+}
+
 void mostrar_menu() {
     printf("\n============================================================\n");
     printf("    SISTEMA INTEGRAL DE GESTION DE CONTAMINACION DEL AIRE\n");
@@ -81,6 +436,9 @@ void mostrar_menu() {
     printf("8. Anadir nueva zona de monitoreo\n");
     printf("9. Editar datos de una zona existente\n");
     printf("10. Eliminar una zona del sistema\n");
+    printf("11. Ingresar lote de datos atrasados de una zona\n");
+    printf("12. Configuracion del sistema\n");
+    printf("13. Simulacion Monte Carlo de escenarios\n");
     printf("0. Salir del sistema\n");
     printf("1000. Reiniciar programa (eliminar todos los datos)\n");
     printf("============================================================\n");
@@ -146,6 +504,17 @@ int leer_int(const char *mensaje, int min, int max, int *valor) {
     return 1;
 }
 
+static void leer_mediciones(RegistroDia *r) {
+    leer_float("PM2.5: ", 0, 99999, &r->pm25);
+    leer_float("PM10: ", 0, 99999, &r->pm10);
+    leer_float("CO2: ", 0, 99999, &r->co2);
+    leer_float("SO2: ", 0, 99999, &r->so2);
+    leer_float("NO2: ", 0, 99999, &r->no2);
+    leer_float("Temperatura (C): ", -50, 60, &r->temperatura);
+    leer_float("Humedad (%%): ", 0, 100, &r->humedad);
+    leer_float("Velocidad viento (km/h): ", 0, 500, &r->velocidad_viento);
+}
+
 void ingresar_datos_actuales(Zona zonas[], int num_zonas) {
     int op;
     printf("\nSeleccione la zona para ingresar datos:\n");
@@ -154,28 +523,99 @@ void ingresar_datos_actuales(Zona zonas[], int num_zonas) {
     if (!leer_int("Opcion: ", 1, num_zonas, &op)) return;
     
     Zona *z = &zonas[op - 1];
-    if (z->dias_registrados == DIAS_HISTORIAL) {
-        for (int i = 1; i < DIAS_HISTORIAL; i++)
-            z->historial[i - 1] = z->historial[i];
-        z->dias_registrados--;
-    }
-    RegistroDia *r = &z->historial[z->dias_registrados];
-    if (!leer_fecha("Ingrese la fecha del nuevo registro:", r->fecha)) {
+    RegistroDia r;
+    if (!leer_fecha("Ingrese la fecha del nuevo registro:", r.fecha)) {
         printf("Operacion cancelada.\n");
         return;
     }
-    leer_float("PM2.5: ", 0, 99999, &r->pm25);
-    leer_float("PM10: ", 0, 99999, &r->pm10);
-    leer_float("CO2: ", 0, 99999, &r->co2);
-    leer_float("SO2: ", 0, 99999, &r->so2);
-    leer_float("NO2: ", 0, 99999, &r->no2);
-    leer_float("Temperatura (C): ", -50, 60, &r->temperatura);
-    leer_float("Humedad (%%): ", 0, 100, &r->humedad);
-    leer_float("Velocidad viento (km/h): ", 0, 500, &r->velocidad_viento);
-    z->dias_registrados++;
-    qsort(z->historial, z->dias_registrados, sizeof(RegistroDia), comparar_fechas);
+    leer_mediciones(&r);
+    encolar_registro(z, &r);
+    int descartadas = consolidar_pendientes(z);
     guardar_zonas(zonas, num_zonas);
+    if (descartadas > 0) {
+        printf("La lectura es anterior a los ultimos %d dias del historial y no se guardo.\n", DIAS_HISTORIAL);
+        return;
+    }
     printf("Datos ingresados y ordenados correctamente.\n");
+    // Las banderas se leen del historial ya consolidado
+    const RegistroDia *guardado = buscar_registro(z, r.fecha);
+    if (guardado && (guardado->anomalias || guardado->sensor_fijo)) {
+        char variables[128];
+        describir_banderas(guardado->anomalias | guardado->sensor_fijo, variables);
+        printf("Advertencia: lectura sospechosa en %s.\n", variables);
+    }
+}
+
+// Carga varias lecturas (p. ej. las que un sensor subio tras una desconexion)
+// y las fusiona con el historial una sola vez al final
+void ingresar_lote_datos(Zona zonas[], int num_zonas) {
+    if (num_zonas == 0) {
+        printf("\nNo hay zonas registradas.\n");
+        return;
+    }
+    int op;
+    printf("\nSeleccione la zona para ingresar el lote de datos:\n");
+    for (int i = 0; i < num_zonas; i++)
+        printf("%d. %s\n", i + 1, zonas[i].nombre);
+    if (!leer_int("Opcion: ", 1, num_zonas, &op)) return;
+
+    Zona *z = &zonas[op - 1];
+    int cantidad;
+    char mensaje[60];
+    sprintf(mensaje, "Cantidad de lecturas a ingresar (1-%d): ", MAX_LOTE);
+    if (!leer_int(mensaje, 1, MAX_LOTE, &cantidad)) return;
+
+    int ingresadas = 0, descartadas = 0;
+    for (int i = 0; i < cantidad; i++) {
+        RegistroDia r;
+        printf("\n--- Lectura %d de %d ---\n", i + 1, cantidad);
+        if (!leer_fecha("Ingrese la fecha de la lectura:", r.fecha)) {
+            printf("Ingreso del lote interrumpido.\n");
+            break;
+        }
+        leer_mediciones(&r);
+        descartadas += encolar_registro(z, &r);
+        ingresadas++;
+    }
+    descartadas += consolidar_pendientes(z);
+    guardar_zonas(zonas, num_zonas);
+    printf("\n%d lecturas fusionadas en el historial de %s.\n", ingresadas - descartadas, z->nombre);
+    if (descartadas > 0)
+        printf("%d lecturas se descartaron por ser anteriores a los ultimos %d dias del historial.\n",
+               descartadas, DIAS_HISTORIAL);
+    int sospechosas = 0;
+    for (int i = 0; i < z->dias_registrados; i++) {
+        if (z->historial[i].anomalias || z->historial[i].sensor_fijo) sospechosas++;
+    }
+    if (sospechosas > 0)
+        printf("Advertencia: %d registros del historial estan marcados como sospechosos.\n", sospechosas);
+}
+
+void configurar_sistema() {
+    int op;
+    do {
+        printf("\n--- Configuracion del sistema ---\n");
+        printf("1. Politica para fechas duplicadas (actual: %s)\n",
+               politica_duplicados == POLITICA_PROMEDIO ? "promediar lecturas" : "la ultima lectura reemplaza");
+        printf("2. Excluir lecturas sospechosas de las predicciones (actual: %s)\n",
+               excluir_sospechosos ? "si" : "no");
+        printf("0. Volver al menu principal\n");
+        if (!leer_int("Opcion: ", 0, 2, &op)) return;
+
+        if (op == 1) {
+            int politica;
+            printf("1. La ultima lectura reemplaza a la anterior\n");
+            printf("2. Promediar las lecturas de la misma fecha\n");
+            printf("   (un dia ya guardado cuenta como una sola lectura al promediar con una nueva)\n");
+            if (!leer_int("Opcion: ", 1, 2, &politica)) continue;
+            politica_duplicados = (politica == 2) ? POLITICA_PROMEDIO : POLITICA_ULTIMO_GANA;
+            printf("Politica actualizada.\n");
+        } else if (op == 2) {
+            excluir_sospechosos = !excluir_sospechosos;
+            printf("Las lecturas sospechosas %s en las predicciones.\n",
+                   excluir_sospechosos ? "se excluiran" : "se incluiran");
+        }
+    } while (op != 0);
 }
 
 void anadir_zona(Zona zonas[], int *num_zonas) {
@@ -185,6 +625,7 @@ void anadir_zona(Zona zonas[], int *num_zonas) {
     }
     
     Zona *nueva_zona = &zonas[*num_zonas];
+    nueva_zona->num_pendientes = 0;
 
     printf("Nombre de la nueva zona: ");
     fgets(nueva_zona->nombre, NOMBRE_ZONA, stdin);
@@ -235,17 +676,11 @@ void anadir_zona(Zona zonas[], int *num_zonas) {
                 *num_zonas = (*num_zonas > 0) ? *num_zonas -1 : 0; // Temporalmente se deshace
                 return;
             }
-            leer_float("PM2.5: ", 0, 99999, &r->pm25);
-            leer_float("PM10: ", 0, 99999, &r->pm10);
-            leer_float("CO2: ", 0, 99999, &r->co2);
-            leer_float("SO2: ", 0, 99999, &r->so2);
-            leer_float("NO2: ", 0, 99999, &r->no2);
-            leer_float("Temperatura (C): ", -50, 60, &r->temperatura);
-            leer_float("Humedad (%%): ", 0, 100, &r->humedad);
-            leer_float("Velocidad viento (km/h): ", 0, 500, &r->velocidad_viento);
+            leer_mediciones(r);
         }
     }
 qsort(nueva_zona->historial, nueva_zona->dias_registrados, sizeof(RegistroDia), comparar_fechas);
+    recalcular_detectores(nueva_zona);
     (*num_zonas)++;
     guardar_zonas(zonas, *num_zonas);
     printf("\nZona agregada correctamente con %d dias de datos.\n", dias_a_generar);
@@ -298,14 +733,11 @@ void editar_zona(Zona zonas[], int num_zonas) {
                 
                 RegistroDia *r = &z->historial[op_fecha - 1];
                 printf("Editando datos para la fecha %s...\n", r->fecha);
-                leer_float("Nuevo PM2.5: ", 0, 99999, &r->pm25);
-                leer_float("Nuevo PM10: ", 0, 99999, &r->pm10);
-                leer_float("Nuevo CO2: ", 0, 99999, &r->co2);
-                leer_float("Nuevo SO2: ", 0, 99999, &r->so2);
-                leer_float("Nuevo NO2: ", 0, 99999, &r->no2);
-                leer_float("Nueva Temperatura (C): ", -50, 60, &r->temperatura);
-                leer_float("Nueva Humedad (%%): ", 0, 100, &r->humedad);
-                leer_float("Nueva Velocidad viento (km/h): ", 0, 500, &r->velocidad_viento);
+                printf("Ingrese los nuevos valores:\n");
+                leer_mediciones(r);
+                // El dia editado se evalua contra los dias previos; los demas conservan sus banderas
+                evaluar_registro_atrasado(z, r);
+                reconstruir_estado_detectores(z);
                 printf("Datos del %s actualizados.\n", r->fecha);
                 break;
             }
@@ -321,9 +753,9 @@ void editar_zona(Zona zonas[], int num_zonas) {
                 int op_fecha;
                 if (!leer_int("Opcion: ", 1, z->dias_registrados, &op_fecha)) break;
 
-                RegistroDia *r = &z->historial[op_fecha - 1];
+                RegistroDia registro = z->historial[op_fecha - 1];
                 char fecha_anterior[11];
-                strcpy(fecha_anterior, r->fecha);
+                strcpy(fecha_anterior, registro.fecha);
 
                 char nueva_fecha[11];
                 if (!leer_fecha("Ingrese la nueva fecha:", nueva_fecha)) {
@@ -331,11 +763,33 @@ void editar_zona(Zona zonas[], int num_zonas) {
                     break;
                 }
 
-                strcpy(r->fecha, nueva_fecha);
-                printf("Fecha del registro actualizada de %s a %s.\n", fecha_anterior, r->fecha);
-                
-                // Ordenar el historial por fecha para mantener la consistencia cronológica
-                qsort(z->historial, z->dias_registrados, sizeof(RegistroDia), comparar_fechas);
+                // La politica de duplicados es para lecturas atrasadas; una edicion no debe fusionar dias
+                int fecha_ocupada = 0;
+                for (int i = 0; i < z->dias_registrados; i++) {
+                    if (i != op_fecha - 1 && strcmp(z->historial[i].fecha, nueva_fecha) == 0)
+                        fecha_ocupada = 1;
+                }
+                if (fecha_ocupada) {
+                    printf("Ya existe un registro con la fecha %s. Edite o elimine ese registro primero.\n", nueva_fecha);
+                    break;
+                }
+
+                // Se retira el registro y se reinserta en su nueva posicion desplazando
+                // solo los registros intermedios, sin reordenar todo el historial
+                memmove(&z->historial[op_fecha - 1], &z->historial[op_fecha],
+                        (z->dias_registrados - op_fecha) * sizeof(RegistroDia));
+                z->dias_registrados--;
+                strcpy(registro.fecha, nueva_fecha);
+                int pos = 0;
+                while (pos < z->dias_registrados && strcmp(z->historial[pos].fecha, registro.fecha) < 0)
+                    pos++;
+                memmove(&z->historial[pos + 1], &z->historial[pos],
+                        (z->dias_registrados - pos) * sizeof(RegistroDia));
+                z->historial[pos] = registro;
+                z->dias_registrados++;
+                evaluar_registro_atrasado(z, &z->historial[pos]);
+                reconstruir_estado_detectores(z);
+                printf("Fecha del registro actualizada de %s a %s.\n", fecha_anterior, registro.fecha);
                 printf("El historial de la zona ha sido reordenado cronologicamente.\n");
                 break;
             }
@@ -370,29 +824,198 @@ void mostrar_predicciones(Zona zonas[], int num_zonas) {
         printf("\nZona: %s\n", zonas[i].nombre);
         printf("------------------------------------------------------------\n");
         printf("PM2.5 | PM10 | CO2  | SO2  | NO2  | Temp | Hum | V.Viento\n");
-        float sumas[8] = {0};
-        float pesos[3] = {0.6, 0.3, 0.1};
-        int dias = zonas[i].dias_registrados;
-        if (dias < 3) {
+        float sumas[NUM_VARIABLES];
+        if (!calcular_prediccion(&zonas[i], sumas)) {
             printf("No hay suficientes datos para predecir.\n");
             continue;
         }
-        for (int j = 0; j < 3; j++) {
-            RegistroDia *r = &zonas[i].historial[dias-1-j];
-            sumas[0] += r->pm25 * pesos[j];
-            sumas[1] += r->pm10 * pesos[j];
-            sumas[2] += r->co2 * pesos[j];
-            sumas[3] += r->so2 * pesos[j];
-            sumas[4] += r->no2 * pesos[j];
-            sumas[5] += r->temperatura * pesos[j];
-            sumas[6] += r->humedad * pesos[j];
-            sumas[7] += r->velocidad_viento * pesos[j];
-        }
         printf("%5.1f | %4.1f | %4.1f | %4.1f | %4.1f | %4.1f | %3.1f | %7.1f\n",
             sumas[0], sumas[1], sumas[2], sumas[3], sumas[4], sumas[5], sumas[6], sumas[7]);
     }
 }
 
+// Generador xorshift64*: rapido y con estado propio por trayectoria, de modo que
+// el resultado no depende de cuantos hilos participen en la simulacion
+static uint64_t mezclar_semilla(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static double aleatorio_uniforme(uint64_t *estado) {
+    *estado ^= *estado >> 12;
+    *estado ^= *estado << 25;
+    *estado ^= *estado >> 27;
+    uint64_t x = *estado * 0x2545F4914F6CDD1DULL;
+    return ((x >> 11) + 1) * (1.0 / 9007199254740993.0); // Intervalo (0, 1]
+}
+
+// Llena 'n' valores normales estandar por Box-Muller, aprovechando ambos resultados de cada par
+static void aleatorios_normales(uint64_t *estado, float normales[], int n) {
+    for (int i = 0; i < n; i += 2) {
+        float radio = sqrtf(-2.0f * logf((float)aleatorio_uniforme(estado)));
+        float angulo = 6.2831853f * (float)aleatorio_uniforme(estado);
+        normales[i] = radio * cosf(angulo);
+        if (i + 1 < n) normales[i + 1] = radio * sinf(angulo);
+    }
+}
+
+static float limitar(float valor, float min, float max) {
+    return valor < min ? min : (valor > max ? max : valor);
+}
+
+// Simula 'trayectorias' dias de 24 horas para la zona a partir de la prediccion puntual.
+// Humedad y viento siguen un proceso AR(1) alrededor de la prediccion, el viento diluye
+// los contaminantes y 'reduccion' (0-1) recorta la parte de origen local de las emisiones.
+// Deja en percentiles[k] los valores P5, P50 y P95 del promedio diario de cada contaminante.
+static int simular_zona(const Zona *z, int trayectorias, float reduccion, unsigned int semilla,
+                        int indice_zona, float percentiles[NUM_CONTAMINANTES][3]) {
+    float base[NUM_VARIABLES], dispersion[NUM_VARIABLES];
+    if (trayectorias <= 0 || !calcular_prediccion(z, base)) return 0;
+
+    // Variabilidad diaria observada en el historial de la zona, con el mismo
+    // criterio de exclusion de lecturas sospechosas que calcular_prediccion
+    for (int k = 0; k < NUM_VARIABLES; k++) {
+        float media = 0, suma_cuadrados = 0;
+        int usados = 0;
+        for (int j = 0; j < z->dias_registrados; j++) {
+            const RegistroDia *r = &z->historial[j];
+            if (excluir_sospechosos && ((r->anomalias | r->sensor_fijo) & (1 << k))) continue;
+            media += leer_variable(r, k);
+            usados++;
+        }
+        dispersion[k] = 0;
+        if (usados >= 2) {
+            media /= usados;
+            for (int j = 0; j < z->dias_registrados; j++) {
+                const RegistroDia *r = &z->historial[j];
+                if (excluir_sospechosos && ((r->anomalias | r->sensor_fijo) & (1 << k))) continue;
+                float d = leer_variable(r, k) - media;
+                suma_cuadrados += d * d;
+            }
+            dispersion[k] = sqrtf(suma_cuadrados / (usados - 1));
+        }
+        if (dispersion[k] <= 0) dispersion[k] = 0.05f * fabsf(base[k]);
+    }
+
+    float *resultados = malloc((size_t)trayectorias * NUM_CONTAMINANTES * sizeof(float));
+    if (!resultados) return 0;
+
+    // Si la prediccion de CO2 queda bajo el fondo, todo se trata como fondo (parte local nula)
+    const float fondo[NUM_CONTAMINANTES] = {0, 0, fminf(base[2], FONDO_CO2), 0, 0};
+    const float innovacion = sqrtf(1 - PERSISTENCIA_HORARIA * PERSISTENCIA_HORARIA);
+    const float viento_base = base[7] > VIENTO_MINIMO ? base[7] : VIENTO_MINIMO;
+    // El ruido horario es AR(1); se escala para que el promedio de 24 horas tenga la
+    // misma desviacion que la variabilidad diaria observada
+    double suma_autocorrelacion = 1;
+    for (int h = 1; h < HORAS_SIMULACION; h++)
+        suma_autocorrelacion += 2.0 * (1.0 - (double)h / HORAS_SIMULACION) * pow(PERSISTENCIA_HORARIA, h);
+    const float ajuste_diario = (float)sqrt(HORAS_SIMULACION / suma_autocorrelacion);
+    float escala_ruido[NUM_CONTAMINANTES]; // Desviacion del ruido aditivo de la parte local
+    for (int k = 0; k < NUM_CONTAMINANTES; k++)
+        escala_ruido[k] = (base[k] - fondo[k] > 0) ? dispersion[k] * ajuste_diario : 0;
+
+    // La dilucion se linealiza alrededor del viento previsto para que sea simetrica y
+    // luego se divide por su valor esperado (los limites la vuelven levemente asimetrica)
+    float suma_pesos = 0, suma_dilucion = 0;
+    for (float u = -4.0f; u <= 4.0f; u += 0.125f) {
+        float peso = expf(-0.5f * u * u);
+        suma_dilucion += peso * limitar(2 - (base[7] + dispersion[7] * u) / viento_base, 0.25f, 4.0f);
+        suma_pesos += peso;
+    }
+    const float dilucion_media = suma_dilucion / suma_pesos;
+
+#ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int t = 0; t < trayectorias; t++) {
+        uint64_t estado = mezclar_semilla(((uint64_t)semilla << 32) ^ ((uint64_t)indice_zona << 24) ^ (uint64_t)t);
+        if (estado == 0) estado = 1;
+        // Indices 0-4: ruido de cada contaminante; 5: humedad; 6: viento.
+        // Los procesos arrancan en su distribucion estacionaria.
+        float normales[NUM_CONTAMINANTES + 2];
+        float anomalia_humedad, anomalia_viento;
+        float ruido[NUM_CONTAMINANTES];
+        float acumulado[NUM_CONTAMINANTES] = {0}; // Suma horaria de la parte local
+        aleatorios_normales(&estado, normales, NUM_CONTAMINANTES + 2);
+        for (int k = 0; k < NUM_CONTAMINANTES; k++)
+            ruido[k] = escala_ruido[k] * normales[k];
+        anomalia_humedad = dispersion[6] * normales[5];
+        anomalia_viento = dispersion[7] * normales[6];
+
+        for (int h = 0; h < HORAS_SIMULACION; h++) {
+            aleatorios_normales(&estado, normales, NUM_CONTAMINANTES + 2);
+            anomalia_humedad = PERSISTENCIA_HORARIA * anomalia_humedad + innovacion * dispersion[6] * normales[5];
+            anomalia_viento = PERSISTENCIA_HORARIA * anomalia_viento + innovacion * dispersion[7] * normales[6];
+            float humedad = limitar(base[6] + anomalia_humedad, 0, 100);
+            float viento = base[7] + anomalia_viento;
+
+            // Mas viento que el previsto diluye la parte local, menos viento la concentra
+            float dilucion = limitar(2 - viento / viento_base, 0.25f, 4.0f) / dilucion_media;
+            // El material particulado crece con la humedad (absorcion de agua)
+            float factor_humedad = 1 + 0.005f * (humedad - base[6]);
+
+            for (int k = 0; k < NUM_CONTAMINANTES; k++) {
+                ruido[k] = PERSISTENCIA_HORARIA * ruido[k] + innovacion * escala_ruido[k] * normales[k];
+                // Ruido aditivo y simetrico: sin reduccion la mediana coincide con la prediccion
+                float local = (base[k] - fondo[k]) * dilucion;
+                if (k <= 1) local *= factor_humedad;
+                acumulado[k] += (local + ruido[k]) * (1 - reduccion);
+            }
+        }
+        // La parte local no puede ser negativa; se limita el promedio diario y no cada
+        // hora, para no desplazar la mediana cuando la parte local es chica
+        for (int k = 0; k < NUM_CONTAMINANTES; k++) {
+            float local = acumulado[k] / HORAS_SIMULACION;
+            resultados[(size_t)k * trayectorias + t] = fondo[k] + (local > 0 ? local : 0);
+        }
+    }
+
+    for (int k = 0; k < NUM_CONTAMINANTES; k++) {
+        float *serie = &resultados[(size_t)k * trayectorias];
+        qsort(serie, trayectorias, sizeof(float), comparar_floats);
+        percentiles[k][0] = serie[(int)(0.05 * (trayectorias - 1))];
+        percentiles[k][1] = serie[(int)(0.50 * (trayectorias - 1))];
+        percentiles[k][2] = serie[(int)(0.95 * (trayectorias - 1))];
+    }
+    free(resultados);
+    return 1;
+}
+
+void simular_escenarios(Zona zonas[], int num_zonas) {
+    int trayectorias, porcentaje, semilla;
+    char mensaje[80];
+
+    printf("\nSIMULACION MONTE CARLO DE ESCENARIOS (24 HORAS)\n");
+    sprintf(mensaje, "Numero de trayectorias por zona (100-%d): ", MAX_TRAYECTORIAS);
+    if (!leer_int(mensaje, 100, MAX_TRAYECTORIAS, &trayectorias)) return;
+    if (!leer_int("Reduccion de emisiones locales a simular (%, 0 = sin cambios): ", 0, 100, &porcentaje)) return;
+    if (!leer_int("Semilla (el mismo valor reproduce los mismos resultados): ", 0, 2147483647, &semilla)) return;
+
+#ifdef _OPENMP
+    printf("Simulando con %d hilos...\n", omp_get_max_threads());
+#endif
+    for (int i = 0; i < num_zonas; i++) {
+        float percentiles[NUM_CONTAMINANTES][3];
+        float puntual[NUM_VARIABLES];
+        printf("\nZona: %s\n", zonas[i].nombre);
+        printf("------------------------------------------------------------\n");
+        if (!calcular_prediccion(&zonas[i], puntual) ||
+            !simular_zona(&zonas[i], trayectorias, porcentaje / 100.0f, (unsigned int)semilla, i, percentiles)) {
+            printf("No hay suficientes datos para simular.\n");
+            continue;
+        }
+        printf("Contaminante | Puntual |    P5   |   P50   |   P95\n");
+        for (int k = 0; k < NUM_CONTAMINANTES; k++) {
+            printf("%-12s | %7.1f | %7.1f | %7.1f | %7.1f\n", nombre_variable(k), puntual[k],
+                   percentiles[k][0], percentiles[k][1], percentiles[k][2]);
+        }
+    }
+    if (porcentaje > 0)
+        printf("\nEscenario con reduccion del %d%% de las emisiones locales.\n", porcentaje);
+}
+
 void mostrar_info_zonas(Zona zonas[], int num_zonas) {
     if (num_zonas == 0) {
         printf("\nNo hay zonas registradas para mostrar.\n");
@@ -434,7 +1057,7 @@ void generar_alertas_y_recomendaciones(Zona zonas[], int num_zonas) {
         int alerta_zona = 0;
 
         // Buffer para acumular los mensajes de alerta de la zona
-        char mensaje_alerta[1024] = "";
+        char mensaje_alerta[2048] = "";
 
         if (r->pm25 > 25 || r->pm10 > 50) {
             alerta_zona = 1;
@@ -466,6 +1089,26 @@ void generar_alertas_y_recomendaciones(Zona zonas[], int num_zonas) {
             strcat(mensaje_alerta, "       - Evitar la quema de combustibles fosiles.\n\n");
         }
 
+        if (r->anomalias || r->sensor_fijo) {
+            char variables[128];
+            alerta_zona = 1;
+            strcat(mensaje_alerta, "  -> ALERTA: Lecturas sospechosas en el ultimo registro.\n");
+            if (r->anomalias) {
+                describir_banderas(r->anomalias, variables);
+                strcat(mensaje_alerta, "     - Valores atipicos respecto al historial: ");
+                strcat(mensaje_alerta, variables);
+                strcat(mensaje_alerta, "\n");
+            }
+            if (r->sensor_fijo) {
+                describir_banderas(r->sensor_fijo, variables);
+                strcat(mensaje_alerta, "     - Sensor repitiendo el mismo valor (posible falla): ");
+                strcat(mensaje_alerta, variables);
+                strcat(mensaje_alerta, "\n");
+            }
+            strcat(mensaje_alerta, "     - RECOMENDACIONES:\n");
+            strcat(mensaje_alerta, "       - Verificar la calibracion y el estado de los sensores de la zona.\n\n");
+        }
+
         if (alerta_zona) {
             alertas_generadas = 1;
             printf("\n------------------------------------------------------------\n");
@@ -489,6 +1132,210 @@ const char* obtener_categoria_ica(float pm25) {
     return "Peligrosa";
 }
 
+// ---------------------------------------------------------------------------
+// Analisis de correlacion y tendencias
+// ---------------------------------------------------------------------------
+
+// Dias transcurridos desde 1970-01-01 para una fecha "YYYY-MM-DD"
+static long dias_desde_epoca(const char *fecha) {
+    int anio, mes, dia;
+    if (sscanf(fecha, "%d-%d-%d", &anio, &mes, &dia) != 3) return 0;
+    anio -= mes <= 2;
+    long era = (anio >= 0 ? anio : anio - 399) / 400;
+    long anio_era = anio - era * 400;
+    long dia_anio = (153 * (mes + (mes > 2 ? -3 : 9)) + 2) / 5 + dia - 1;
+    long dia_era = anio_era * 365 + anio_era / 4 - anio_era / 100 + dia_anio;
+    return era * 146097 + dia_era - 719468;
+}
+
+// Acumula en una sola pasada sumas y productos cruzados de las variables y del tiempo.
+// Los valores se desplazan respecto al primer registro para no perder precision.
+static void acumular_estadisticas(AcumuladorEstadistico *a, const RegistroDia registros[], int n) {
+    float columnas[NUM_COLUMNAS][BLOQUE_ANALISIS];
+
+    for (int inicio = 0; inicio < n; inicio += BLOQUE_ANALISIS) {
+        int tam = (n - inicio < BLOQUE_ANALISIS) ? n - inicio : BLOQUE_ANALISIS;
+
+        // Se transpone el bloque a columnas contiguas; con OpenMP las sumas internas se
+        // declaran como reducciones SIMD para que el compilador pueda vectorizarlas
+        for (int i = 0; i < tam; i++) {
+            const RegistroDia *r = &registros[inicio + i];
+            if (a->n == 0 && i == 0) {
+                for (int k = 0; k < NUM_VARIABLES; k++)
+                    a->referencia[k] = leer_variable(r, k);
+                a->referencia[NUM_VARIABLES] = (double)dias_desde_epoca(r->fecha);
+            }
+            for (int k = 0; k < NUM_VARIABLES; k++)
+                columnas[k][i] = (float)(leer_variable(r, k) - a->referencia[k]);
+            columnas[NUM_VARIABLES][i] = (float)(dias_desde_epoca(r->fecha) - a->referencia[NUM_VARIABLES]);
+        }
+
+        for (int x = 0; x < NUM_COLUMNAS; x++) {
+            float suma = 0;
+#ifdef _OPENMP
+            #pragma omp simd reduction(+:suma)
+#endif
+            for (int i = 0; i < tam; i++)
+                suma += columnas[x][i];
+            a->suma[x] += suma;
+            for (int y = 0; y <= x; y++) {
+                float producto = 0;
+#ifdef _OPENMP
+                #pragma omp simd reduction(+:producto)
+#endif
+                for (int i = 0; i < tam; i++)
+                    producto += columnas[x][i] * columnas[y][i];
+                a->productos[x][y] += producto;
+            }
+        }
+        a->n += tam;
+    }
+}
+
+// Covarianza poblacional entre dos columnas del acumulador
+static double covarianza(const AcumuladorEstadistico *a, int x, int y) {
+    if (x < y) { int t = x; x = y; y = t; }
+    return a->productos[x][y] / a->n - (a->suma[x] / a->n) * (a->suma[y] / a->n);
+}
+
+// Devuelve 1 y deja la correlacion en 'resultado' si hay datos y variacion suficientes
+static int correlacion(const AcumuladorEstadistico *a, int x, int y, double *resultado) {
+    if (a->n < 3) return 0;
+    double vx = covarianza(a, x, x), vy = covarianza(a, y, y);
+    if (vx <= 1e-12 || vy <= 1e-12) return 0;
+    *resultado = covarianza(a, x, y) / sqrt(vx * vy);
+    return 1;
+}
+
+// Acumula pares (contaminante del dia d, clima del dia d - retardo) separados por fecha real
+static void acumular_retardos(AcumuladorPares pares[MAX_RETARDO][NUM_CONTAMINANTES][3],
+                              const RegistroDia registros[], int n) {
+    for (int i = 0; i < n; i++) {
+        long dia_i = dias_desde_epoca(registros[i].fecha);
+        for (int j = i - 1; j >= 0; j--) {
+            long retardo = dia_i - dias_desde_epoca(registros[j].fecha);
+            if (retardo > MAX_RETARDO) break;
+            if (retardo < 1) continue;
+            for (int k = 0; k < NUM_CONTAMINANTES; k++) {
+                double x = leer_variable(&registros[i], k);
+                for (int c = 0; c < 3; c++) {
+                    double y = leer_variable(&registros[j], NUM_CONTAMINANTES + c);
+                    AcumuladorPares *p = &pares[retardo - 1][k][c];
+                    p->n++;
+                    p->sx += x; p->sy += y;
+                    p->sxx += x * x; p->syy += y * y; p->sxy += x * y;
+                }
+            }
+        }
+    }
+}
+
+static void escribir_analisis(FILE *f, const AcumuladorEstadistico *a,
+                              AcumuladorPares pares[MAX_RETARDO][NUM_CONTAMINANTES][3]) {
+    double r;
+
+    fprintf(f, "MATRIZ DE CORRELACION (%d registros):\n", (int)a->n);
+    fprintf(f, "%-12s", "");
+    for (int y = 0; y < NUM_VARIABLES; y++)
+        fprintf(f, " %7.7s", nombre_variable(y));
+    fprintf(f, "\n");
+    for (int x = 0; x < NUM_VARIABLES; x++) {
+        fprintf(f, "%-12s", nombre_variable(x));
+        for (int y = 0; y < NUM_VARIABLES; y++) {
+            if (correlacion(a, x, y, &r)) fprintf(f, " %7.2f", r);
+            else fprintf(f, " %7s", "n/d");
+        }
+        fprintf(f, "\n");
+    }
+
+    fprintf(f, "\nCORRELACION CON RETARDO (contaminante vs clima de dias anteriores):\n");
+    fprintf(f, "Contaminante | Clima       |");
+    for (int l = 1; l <= MAX_RETARDO; l++)
+        fprintf(f, " %d dia(s) |", l);
+    fprintf(f, "\n");
+    for (int k = 0; k < NUM_CONTAMINANTES; k++) {
+        for (int c = 0; c < 3; c++) {
+            fprintf(f, "%-12s | %-11s |", nombre_variable(k), nombre_variable(NUM_CONTAMINANTES + c));
+            for (int l = 0; l < MAX_RETARDO; l++) {
+                AcumuladorPares *p = &pares[l][k][c];
+                double vx = p->n * p->sxx - p->sx * p->sx;
+                double vy = p->n * p->syy - p->sy * p->sy;
+                if (p->n >= 3 && vx > 1e-9 && vy > 1e-9)
+                    fprintf(f, " %8.2f |", (p->n * p->sxy - p->sx * p->sy) / sqrt(vx * vy));
+                else
+                    fprintf(f, " %8s |", "n/d");
+            }
+            fprintf(f, "\n");
+        }
+    }
+
+    fprintf(f, "\nTENDENCIAS LINEALES (cambio por dia):\n");
+    double var_tiempo = (a->n >= 2) ? covarianza(a, NUM_VARIABLES, NUM_VARIABLES) : 0;
+    for (int k = 0; k < NUM_VARIABLES; k++) {
+        if (var_tiempo > 0)
+            fprintf(f, "%-12s %+.3f\n", nombre_variable(k), covarianza(a, k, NUM_VARIABLES) / var_tiempo);
+        else
+            fprintf(f, "%-12s n/d\n", nombre_variable(k));
+    }
+}
+
+static void reportar_analisis_zona(FILE *f, const Zona *z) {
+    AcumuladorEstadistico acumulador;
+    AcumuladorPares pares[MAX_RETARDO][NUM_CONTAMINANTES][3];
+    memset(&acumulador, 0, sizeof(acumulador));
+    memset(pares, 0, sizeof(pares));
+
+    acumular_estadisticas(&acumulador, z->historial, z->dias_registrados);
+    acumular_retardos(pares, z->historial, z->dias_registrados);
+    escribir_analisis(f, &acumulador, pares);
+}
+
+// Analiza la serie diaria de la ciudad: para cada fecha se promedian las zonas que
+// tienen registro ese dia, asi las diferencias de nivel entre zonas no entran en
+// las correlaciones
+static void reportar_analisis_ciudad(FILE *f, Zona zonas[], int num_zonas) {
+    RegistroDia todos[MAX_ZONAS * DIAS_HISTORIAL];
+    RegistroDia serie[MAX_ZONAS * DIAS_HISTORIAL];
+    int total = 0, fechas = 0;
+
+    for (int i = 0; i < num_zonas; i++) {
+        memcpy(&todos[total], zonas[i].historial, zonas[i].dias_registrados * sizeof(RegistroDia));
+        total += zonas[i].dias_registrados;
+    }
+    qsort(todos, total, sizeof(RegistroDia), comparar_fechas);
+
+    for (int inicio = 0; inicio < total; ) {
+        int fin = inicio;
+        while (fin < total && strcmp(todos[fin].fecha, todos[inicio].fecha) == 0)
+            fin++;
+        RegistroDia *promedio = &serie[fechas++];
+        memset(promedio, 0, sizeof(RegistroDia));
+        strcpy(promedio->fecha, todos[inicio].fecha);
+        for (int k = 0; k < NUM_VARIABLES; k++) {
+            float suma = 0;
+            for (int j = inicio; j < fin; j++)
+                suma += leer_variable(&todos[j], k);
+            *valor_variable(promedio, k) = suma / (fin - inicio);
+        }
+        inicio = fin;
+    }
+
+    AcumuladorEstadistico acumulador;
+    AcumuladorPares pares[MAX_RETARDO][NUM_CONTAMINANTES][3];
+    memset(&acumulador, 0, sizeof(acumulador));
+    memset(pares, 0, sizeof(pares));
+    acumular_estadisticas(&acumulador, serie, fechas);
+    acumular_retardos(pares, serie, fechas);
+
+    fprintf(f, "=== ANALISIS DE CORRELACION Y TENDENCIAS DE LA CIUDAD ===\n\n");
+    if (fechas == 0) {
+        fprintf(f, "No hay datos registrados.\n");
+        return;
+    }
+    fprintf(f, "Serie diaria promedio de las zonas: %d fechas a partir de %d registros.\n\n", fechas, total);
+    escribir_analisis(f, &acumulador, pares);
+}
+
 void generar_reporte(Zona zonas[], int num_zonas) {
     FILE *f = fopen("reporte_integral.txt", "w");
     if (!f) {
@@ -525,17 +1372,8 @@ void generar_reporte(Zona zonas[], int num_zonas) {
             fprintf(f, "Viento: %.1f km/h\n\n", r_actual->velocidad_viento);
 
             fprintf(f, "PREDICCIONES 24H:\n");
-            if (z->dias_registrados >= 3) {
-                float sumas[5] = {0};
-                float pesos[3] = {0.6, 0.3, 0.1};
-                for (int j = 0; j < 3; j++) {
-                    RegistroDia *r_hist = &z->historial[z->dias_registrados - 1 - j];
-                    sumas[0] += r_hist->pm25 * pesos[j];
-                    sumas[1] += r_hist->pm10 * pesos[j];
-                    sumas[2] += r_hist->co2 * pesos[j];
-                    sumas[3] += r_hist->so2 * pesos[j];
-                    sumas[4] += r_hist->no2 * pesos[j];
-                }
+            float sumas[NUM_VARIABLES];
+            if (calcular_prediccion(z, sumas)) {
                 fprintf(f, "PM2.5: %.2f ug/m3\n", sumas[0]);
                 fprintf(f, "PM10:  %.2f ug/m3\n", sumas[1]);
                 fprintf(f, "CO2:   %.2f ppm\n", sumas[2]);
@@ -563,12 +1401,38 @@ void generar_reporte(Zona zonas[], int num_zonas) {
             fprintf(f, "SO2:   %.2f ug/m3\n", promedios[3] / z->dias_registrados);
             fprintf(f, "NO2:   %.2f ug/m3\n", promedios[4] / z->dias_registrados);
 
+            fprintf(f, "\nLECTURAS SOSPECHOSAS:\n");
+            int sospechosas = 0;
+            for (int j = 0; j < z->dias_registrados; j++) {
+                RegistroDia *r = &z->historial[j];
+                char variables[128];
+                if (r->anomalias) {
+                    describir_banderas(r->anomalias, variables);
+                    fprintf(f, "%s: valores atipicos en %s\n", r->fecha, variables);
+                    sospechosas++;
+                }
+                if (r->sensor_fijo) {
+                    describir_banderas(r->sensor_fijo, variables);
+                    fprintf(f, "%s: sensor con valor repetido en %s\n", r->fecha, variables);
+                    sospechosas++;
+                }
+            }
+            if (sospechosas == 0)
+                fprintf(f, "Ninguna.\n");
+            if (excluir_sospechosos)
+                fprintf(f, "(Las lecturas sospechosas se excluyen de las predicciones)\n");
+
+            fprintf(f, "\n");
+            reportar_analisis_zona(f, z);
+
         } else {
             fprintf(f, "No hay datos registrados para esta zona.\n");
         }
         fprintf(f, "\n==================================================\n\n");
     }
 
+    reportar_analisis_ciudad(f, zonas, num_zonas);
+
     fclose(f);
     printf("Reporte integral generado en reporte_integral.txt\n");
 }
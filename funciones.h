@@ -4,17 +4,38 @@
 #define MAX_ZONAS 20
 #define DIAS_HISTORIAL 7
 #define NOMBRE_ZONA 40
+#define MAX_PENDIENTES 16
+#define MAX_LOTE 50
+#define NUM_VARIABLES 8
+#define VENTANA_MAD 7
+
+// Politicas para resolver registros con la misma fecha
+#define POLITICA_ULTIMO_GANA 0
+#define POLITICA_PROMEDIO 1
 
 typedef struct {
     char fecha[11]; // "YYYY-MM-DD"
     float pm25, pm10, co2, so2, no2;
     float temperatura, humedad, velocidad_viento;
+    unsigned char anomalias;   // Bit k activo: valor atipico en la variable k
+    unsigned char sensor_fijo; // Bit k activo: el sensor de la variable k repite el mismo valor
 } RegistroDia;
 
+// Estado del detector en linea de una variable (memoria constante por lectura)
+typedef struct {
+    int muestras;
+    float media, varianza;        // Media y varianza exponenciales (EWMA)
+    float ventana[VENTANA_MAD];   // Ultimos valores para la MAD movil
+    int repeticiones;             // Lecturas consecutivas con el mismo valor
+} DetectorVariable;
+
 typedef struct {
     char nombre[NOMBRE_ZONA];
     int dias_registrados;
     RegistroDia historial[DIAS_HISTORIAL];
+    int num_pendientes; // Lecturas atrasadas aun no fusionadas al historial
+    RegistroDia pendientes[MAX_PENDIENTES];
+    DetectorVariable detectores[NUM_VARIABLES];
 } Zona;
 
 int cargar_zonas(Zona zonas[], int *num_zonas);
@@ -37,4 +58,8 @@ int leer_int(const char *mensaje, int min, int max, int *valor);
 void limpiar_buffer();
 int comparar_fechas(const void *a, const void *b);
 int leer_fecha(const char *mensaje, char *fecha_str);
+void ingresar_lote_datos(Zona zonas[], int num_zonas);
+void configurar_sistema();
+void recalcular_detectores(Zona *z);
+void simular_escenarios(Zona zonas[], int num_zonas);
 #endif
@@ -17,6 +17,7 @@ int main() {
             strncpy(zonas[i].nombre, nombres[i], NOMBRE_ZONA - 1);
             zonas[i].nombre[NOMBRE_ZONA - 1] = '\0';
             zonas[i].dias_registrados = DIAS_HISTORIAL;
+            zonas[i].num_pendientes = 0;
             for (int j = 0; j < DIAS_HISTORIAL; j++) {
                 RegistroDia *r = &zonas[i].historial[j];
                 sprintf(r->fecha, "2025-07-%02d", j + 1);
@@ -29,6 +30,7 @@ int main() {
                 r->humedad = 50.0f + (rand() % 300) / 10.0f;
                 r->velocidad_viento = 5.0f + (rand() % 150) / 10.0f;
             }
+            recalcular_detectores(&zonas[i]);
         }
         guardar_zonas(zonas, num_zonas);
         printf("Archivo de datos inicial creado con 5 zonas y 7 dias de historial.\n");
@@ -52,6 +54,9 @@ int main() {
             case 8: anadir_zona(zonas, &num_zonas); break;
             case 9: editar_zona(zonas, num_zonas); break;
             case 10: eliminar_zona(zonas, &num_zonas); break;
+            case 11: ingresar_lote_datos(zonas, num_zonas); break;
+            case 12: configurar_sistema(); break;
+            case 13: simular_escenarios(zonas, num_zonas); break;
             case 1000:
                 reiniciar_programa();
                 num_zonas = 0; // Reinicia el contador de zonas